@@ -0,0 +1,166 @@
+/** @file
+    @brief Header containing lock-free counters and histograms for live
+   performance metrics of the calibration app.
+
+    @date 2015
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2015 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_Metrics_h_GUID_6B0F3E41_8C2A_4D5E_9F17_2E4A61C0B7D3
+#define INCLUDED_Metrics_h_GUID_6B0F3E41_8C2A_4D5E_9F17_2E4A61C0B7D3
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace osvr {
+namespace metrics {
+    /// @brief Clock used for all timing measurements.
+    typedef std::chrono::steady_clock Clock;
+
+    /// @brief Monotonic counter, safe to bump from the render thread and read
+    /// from any other thread without locking.
+    class Counter {
+      public:
+        void increment(std::uint64_t n = 1) {
+            m_value.fetch_add(n, std::memory_order_relaxed);
+        }
+        std::uint64_t get() const {
+            return m_value.load(std::memory_order_relaxed);
+        }
+
+      private:
+        std::atomic<std::uint64_t> m_value{0};
+    };
+
+    /// @brief Fixed-bucket histogram of durations. Observing is a few relaxed
+    /// atomic adds; a reader may see a sample in the count but not yet in the
+    /// sum, which is fine for monitoring.
+    class DurationHistogram {
+      public:
+        /// Upper bounds of the buckets, in seconds; the last bucket is +Inf.
+        static const std::size_t NumBounds = 12;
+        static std::array<double, NumBounds> const &bounds() {
+            static const std::array<double, NumBounds> b = {
+                {0.0005, 0.001, 0.002, 0.004, 0.008, 0.011, 0.0167, 0.025,
+                 0.05, 0.1, 1., 10.}};
+            return b;
+        }
+
+        void observe(Clock::duration d) {
+            auto const ns =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(d)
+                    .count();
+            auto const seconds = ns * 1e-9;
+            std::size_t i = 0;
+            while (i < NumBounds && seconds > bounds()[i]) {
+                ++i;
+            }
+            m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+            m_sumNs.fetch_add(static_cast<std::uint64_t>(ns),
+                              std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// @brief Writes the histogram in Prometheus text exposition format.
+        /// @param labels Extra labels, already formatted (`a="b"`), or empty.
+        void write(std::ostream &os, std::string const &name,
+                   std::string const &labels = std::string()) const {
+            auto const sep = labels.empty() ? "" : ",";
+            std::uint64_t cumulative = 0;
+            for (std::size_t i = 0; i < NumBounds; ++i) {
+                cumulative += m_buckets[i].load(std::memory_order_relaxed);
+                os << name << "_bucket{" << labels << sep << "le=\""
+                   << bounds()[i] << "\"} " << cumulative << "\n";
+            }
+            cumulative += m_buckets[NumBounds].load(std::memory_order_relaxed);
+            os << name << "_bucket{" << labels << sep << "le=\"+Inf\"} "
+               << cumulative << "\n";
+            auto const braced = labels.empty() ? labels : "{" + labels + "}";
+            os << name << "_sum" << braced << " "
+               << m_sumNs.load(std::memory_order_relaxed) * 1e-9 << "\n";
+            os << name << "_count" << braced << " "
+               << m_count.load(std::memory_order_relaxed) << "\n";
+        }
+
+      private:
+        std::array<std::atomic<std::uint64_t>, NumBounds + 1> m_buckets{};
+        std::atomic<std::uint64_t> m_sumNs{0};
+        std::atomic<std::uint64_t> m_count{0};
+    };
+
+    /// @brief Measures the time since construction or the last lap.
+    class Stopwatch {
+      public:
+        Stopwatch() : m_start(Clock::now()) {}
+
+        /// @brief Returns the time since the last lap and starts a new one.
+        Clock::duration lap() {
+            auto const now = Clock::now();
+            auto const ret = now - m_start;
+            m_start = now;
+            return ret;
+        }
+
+      private:
+        Clock::time_point m_start;
+    };
+
+    /// @brief All the metrics updated by the calibration routine.
+    struct CalibrationMetrics {
+        /// Frame phases, in the order they happen in the frame loop.
+        enum Phase {
+            Events,
+            Clear,
+            Update,
+            Render,
+            Present,
+            /// Preview copy and presentation, only recorded with --mirror.
+            Mirror,
+            NumPhases
+        };
+        static const char *phaseName(Phase p) {
+            static const char *names[] = {"events", "clear",   "update",
+                                          "render", "present", "mirror"};
+            return names[p];
+        }
+
+        std::array<DurationHistogram, NumPhases> framePhase;
+        DurationHistogram frame;
+        DurationHistogram ctxUpdate;
+        DurationHistogram surface;
+        Counter frames;
+        Counter surfacesCompleted;
+        Counter events;
+    };
+} // namespace metrics
+} // namespace osvr
+
+#endif // INCLUDED_Metrics_h_GUID_6B0F3E41_8C2A_4D5E_9F17_2E4A61C0B7D3
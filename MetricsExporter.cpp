@@ -0,0 +1,215 @@
+/** @file
+    @brief Implementation of the localhost HTTP endpoint serving the
+   calibration metrics in Prometheus text format.
+
+    @date 2015
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2015 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "MetricsExporter.h"
+
+// Library/third-party includes
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Standard includes
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace osvr {
+namespace metrics {
+    namespace {
+#ifdef _WIN32
+        typedef SOCKET NativeSocket;
+        inline void closeSocket(NativeSocket s) { closesocket(s); }
+        inline bool isValid(NativeSocket s) { return s != INVALID_SOCKET; }
+#else
+        typedef int NativeSocket;
+        inline void closeSocket(NativeSocket s) { close(s); }
+        inline bool isValid(NativeSocket s) { return s >= 0; }
+#endif
+        inline NativeSocket native(std::intptr_t s) {
+            return static_cast<NativeSocket>(s);
+        }
+
+        /// @brief Keeps a stalled client from holding up the server thread.
+        inline void setReceiveTimeout(NativeSocket s) {
+#ifdef _WIN32
+            DWORD timeout = 1000;
+#else
+            timeval timeout = {};
+            timeout.tv_sec = 1;
+#endif
+            setsockopt(s, SOL_SOCKET, SO_RCVTIMEO,
+                       reinterpret_cast<const char *>(&timeout),
+                       sizeof(timeout));
+        }
+
+#ifdef MSG_NOSIGNAL
+        static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+        static const int SEND_FLAGS = 0;
+#endif
+
+        /// How often the server thread wakes up to check for shutdown and to
+        /// recompute rates.
+        static const auto RATE_INTERVAL = std::chrono::seconds(1);
+    } // namespace
+
+    Exporter::Exporter(CalibrationMetrics const &metrics, std::uint16_t port)
+        : m_metrics(metrics), m_lastEvents(metrics.events.get()),
+          m_lastRateUpdate(Clock::now()) {
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            throw std::runtime_error("Could not initialize Winsock");
+        }
+#endif
+        auto const s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (!isValid(s)) {
+            throw std::runtime_error("Could not create metrics socket");
+        }
+        int one = 1;
+#ifdef _WIN32
+        // On Windows SO_REUSEADDR would let us share a port another process
+        // is listening on; insist on having it to ourselves instead.
+        setsockopt(s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE,
+                   reinterpret_cast<const char *>(&one), sizeof(one));
+#else
+        // Allow a quick restart while the old socket is in TIME_WAIT.
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR,
+                   reinterpret_cast<const char *>(&one), sizeof(one));
+#endif
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            listen(s, 4) != 0) {
+            closeSocket(s);
+            throw std::runtime_error("Could not listen on 127.0.0.1:" +
+                                     std::to_string(port));
+        }
+        m_socket = static_cast<std::intptr_t>(s);
+        m_thread = std::thread([&] { run(); });
+    }
+
+    Exporter::~Exporter() {
+        m_stop = true;
+        m_thread.join();
+        closeSocket(native(m_socket));
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    void Exporter::run() {
+        auto const s = native(m_socket);
+        while (!m_stop) {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(s, &readable);
+            timeval timeout = {};
+            timeout.tv_sec = RATE_INTERVAL.count();
+            auto const ready = select(static_cast<int>(s + 1), &readable,
+                                      nullptr, nullptr, &timeout);
+            updateRates();
+            if (ready <= 0) {
+                continue;
+            }
+            auto const client = accept(s, nullptr, nullptr);
+            if (isValid(client)) {
+                serveClient(static_cast<std::intptr_t>(client));
+                closeSocket(client);
+            }
+        }
+    }
+
+    void Exporter::updateRates() {
+        auto const now = Clock::now();
+        auto const elapsed = now - m_lastRateUpdate;
+        if (elapsed < RATE_INTERVAL) {
+            return;
+        }
+        auto const events = m_metrics.events.get();
+        m_eventsPerSecond =
+            (events - m_lastEvents) /
+            std::chrono::duration_cast<std::chrono::duration<double>>(elapsed)
+                .count();
+        m_lastEvents = events;
+        m_lastRateUpdate = now;
+    }
+
+    void Exporter::serveClient(std::intptr_t client) {
+        auto const c = native(client);
+        // We serve the same document for any request, so just drain what the
+        // client sent without parsing it.
+        setReceiveTimeout(c);
+        char request[1024];
+        recv(c, request, sizeof(request), 0);
+
+        std::ostringstream body;
+        body << "# TYPE osvr_calib_frame_phase_seconds histogram\n";
+        for (int i = 0; i < CalibrationMetrics::NumPhases; ++i) {
+            auto const phase = static_cast<CalibrationMetrics::Phase>(i);
+            m_metrics.framePhase[i].write(
+                body, "osvr_calib_frame_phase_seconds",
+                std::string("phase=\"") + CalibrationMetrics::phaseName(phase) +
+                    "\"");
+        }
+        body << "# TYPE osvr_calib_frame_seconds histogram\n";
+        m_metrics.frame.write(body, "osvr_calib_frame_seconds");
+        body << "# TYPE osvr_calib_ctx_update_seconds histogram\n";
+        m_metrics.ctxUpdate.write(body, "osvr_calib_ctx_update_seconds");
+        body << "# TYPE osvr_calib_surface_seconds histogram\n";
+        m_metrics.surface.write(body, "osvr_calib_surface_seconds");
+        body << "# TYPE osvr_calib_frames_total counter\n"
+             << "osvr_calib_frames_total " << m_metrics.frames.get() << "\n"
+             << "# TYPE osvr_calib_surfaces_completed_total counter\n"
+             << "osvr_calib_surfaces_completed_total "
+             << m_metrics.surfacesCompleted.get() << "\n"
+             << "# TYPE osvr_calib_events_total counter\n"
+             << "osvr_calib_events_total " << m_metrics.events.get() << "\n"
+             << "# TYPE osvr_calib_events_per_second gauge\n"
+             << "osvr_calib_events_per_second " << m_eventsPerSecond << "\n";
+
+        auto const content = body.str();
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << content.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << content;
+        auto const data = response.str();
+        send(c, data.data(), static_cast<int>(data.size()), SEND_FLAGS);
+    }
+} // namespace metrics
+} // namespace osvr
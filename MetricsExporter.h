@@ -0,0 +1,74 @@
+/** @file
+    @brief Header declaring a minimal localhost HTTP endpoint serving the
+   calibration metrics in Prometheus text format.
+
+    @date 2015
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2015 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_MetricsExporter_h_GUID_A3C5D2B8_71E4_4F09_8B6D_5E0C9A4F2731
+#define INCLUDED_MetricsExporter_h_GUID_A3C5D2B8_71E4_4F09_8B6D_5E0C9A4F2731
+
+// Internal Includes
+#include "Metrics.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace osvr {
+namespace metrics {
+    /// @brief Serves the metrics over HTTP on 127.0.0.1 from a background
+    /// thread. The exporter only ever reads the atomics in the metrics
+    /// object, so the render loop never waits on it.
+    class Exporter {
+      public:
+        /// @brief Binds the listening socket and starts the server thread.
+        /// @throws std::runtime_error if the port cannot be bound.
+        Exporter(CalibrationMetrics const &metrics, std::uint16_t port);
+        /// @brief Stops the server thread (within about a second).
+        ~Exporter();
+
+        Exporter(Exporter const &) = delete;            //< non-copyable
+        Exporter &operator=(Exporter const &) = delete; //< non-assignable
+
+      private:
+        void run();
+        void serveClient(std::intptr_t client);
+        void updateRates();
+
+        CalibrationMetrics const &m_metrics;
+        std::intptr_t m_socket;
+        std::atomic<bool> m_stop{false};
+        /// Events per second over the last rate interval; only touched by
+        /// the server thread.
+        double m_eventsPerSecond = 0;
+        std::uint64_t m_lastEvents = 0;
+        Clock::time_point m_lastRateUpdate;
+        std::thread m_thread;
+    };
+} // namespace metrics
+} // namespace osvr
+
+#endif // INCLUDED_MetricsExporter_h_GUID_A3C5D2B8_71E4_4F09_8B6D_5E0C9A4F2731
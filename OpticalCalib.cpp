@@ -35,19 +35,51 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "SDL2Helpers.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
+#include "SoakSession.h"
 
 // Standard includes
 #include <iostream>
 #include <cstdint>
 #include <cmath>
-#if 0
-static auto const WIDTH = 1920;
-static auto const HEIGHT = 1080;
-#endif
+#include <climits>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
 
+/// Size of the optional scaled preview (mirror) window on the desktop.
 static auto const WIDTH = 1920 / 2;
 static auto const HEIGHT = 1080 / 2;
 
+/// @brief How buffer swaps on the HMD window are synchronized to its refresh.
+enum class SwapPolicy {
+    /// Swap immediately: lowest latency, may tear.
+    Immediate,
+    /// Wait for vertical blank: no tearing.
+    VSync,
+    /// Late swap tearing where supported, otherwise falls back to VSync.
+    Adaptive
+};
+
+/// @brief App configuration, settable from the command line.
+struct AppOptions {
+    /// SDL display index to use, or -1 to find the HMD using the resolution
+    /// reported by the OSVR display config.
+    int displayIndex = -1;
+    SwapPolicy swapPolicy = SwapPolicy::VSync;
+    /// Ask the window manager to unredirect our fullscreen window.
+    bool bypassCompositor = true;
+    /// Show a scaled copy of the HMD output in a desktop window.
+    bool mirror = false;
+    /// Port on 127.0.0.1 to serve metrics on, or 0 for no metrics endpoint.
+    std::uint16_t metricsPort = 0;
+    /// After calibrating, keep all patterns up and collect soak statistics.
+    bool soak = false;
+    osvr::soak::SoakOptions soakOptions;
+};
+
 using Radius = std::uint16_t;
 
 // Forward declarations of rendering functions defined below.
@@ -163,6 +195,7 @@ class EyeSurfaceCalibration {
 
     glm::vec2 const &getCenter() const { return m_center; }
     Radius getRadius() const { return m_radius; }
+    osvr::clientkit::Surface const &getSurface() const { return m_surface; }
     /// @brief Entry point for rendering
     void render() {
         /// For each viewer, eye, surface combination...
@@ -173,17 +206,9 @@ class EyeSurfaceCalibration {
 
   private:
     void handleSurface(osvr::clientkit::Surface const &surface) {
-        std::cout << "Render: " << surface;
         if (surface != m_surface) {
-            std::cout << " - skip this surface" << std::endl;
             return;
         }
-        std::cout << " - draw this surface" << std::endl;
-
-        std::cout << "Viewport" << static_cast<GLint>(m_viewport.left) << "<"
-            << static_cast<GLint>(m_viewport.bottom) << "<"
-            << static_cast<GLsizei>(m_viewport.width) << "<"
-            << static_cast<GLsizei>(m_viewport.height) << std::endl;
         /// Use the viewport provided
         glViewport(static_cast<GLint>(m_viewport.left),
             static_cast<GLint>(m_viewport.bottom),
@@ -222,7 +247,13 @@ class EyeSurfaceCalibration {
 
 class CalibrationRoutine {
   public:
-    CalibrationRoutine() : ctx("org.osvr.OpticalCalibration"), display(ctx) {
+    /// @param soakSource Measurement source, opened up front; required if
+    /// soak mode is enabled in @p opts.
+    CalibrationRoutine(AppOptions const &opts,
+                       osvr::metrics::CalibrationMetrics &metrics,
+                       std::unique_ptr<osvr::soak::Source> soakSource)
+        : options(opts), metrics(metrics), soakSource(std::move(soakSource)),
+          ctx("org.osvr.OpticalCalibration"), display(ctx) {
 
         if (!display.valid()) {
             std::cerr << "\nCould not get display config (server probably not "
@@ -234,6 +265,8 @@ class CalibrationRoutine {
         std::cout << "Waiting for the display to fully start up, including "
                      "receiving initial pose update..."
                   << std::endl;
+        // Not timed: this busy loop would swamp the per-frame update
+        // histogram.
         while (!display.checkStartup()) {
             ctx.update();
         }
@@ -241,66 +274,331 @@ class CalibrationRoutine {
     }
 
     void operator()() {
-        // Create a window
-        window = osvr::SDL2::createWindow(
-            "OSVR", 15, 15, WIDTH, HEIGHT,
-            SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN); // | SDL_WINDOW_BORDERLESS);
+        createHMDWindow();
+        if (options.mirror) {
+            mirrorWindow = osvr::SDL2::createWindow(
+                "OSVR Optical Calibration (preview)", 15, 15, WIDTH, HEIGHT,
+                SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+            if (!mirrorWindow) {
+                std::cerr << "Could not create preview window, continuing "
+                             "without it: "
+                          << SDL_GetError() << std::endl;
+            }
+        }
         {
-            // Create an OpenGL context and make it current.
+            // Create an OpenGL context and make it current. The preview
+            // window, if any, shares this same context.
             osvr::SDL2::GLContext glctx(window.get());
+            applySwapPolicy();
             glDisable(GL_LIGHTING);
             glDisable(GL_DEPTH_TEST);
             glDisable(GL_TEXTURE_2D);
+            if (mirrorWindow) {
+                setupMirror(glctx);
+            }
 #ifndef __ANDROID__ // Don't want to pop up the on-screen keyboard
             osvr::SDL2::TextInput textinput;
 #endif
             display.forEachSurface([&](osvr::clientkit::Surface surface) {
                 handleSurface(surface, glctx);
             });
+            if (options.soak && !quit) {
+                runSoak(glctx);
+            }
+            if (mirrorTexture) {
+                glDeleteTextures(1, &mirrorTexture);
+                mirrorTexture = 0;
+            }
         }
+        mirrorWindow = nullptr;
         window = nullptr;
     }
 
   private:
+    /// @brief Picks the SDL display that the HMD is connected to: either the
+    /// one requested, or one whose native resolution matches the display
+    /// input described in the OSVR config. Non-primary displays are preferred
+    /// on a tie, since the primary is usually the desktop monitor.
+    int findHMDDisplay() {
+        auto const numDisplays = SDL_GetNumVideoDisplays();
+        if (options.displayIndex >= 0) {
+            if (options.displayIndex >= numDisplays) {
+                throw std::runtime_error("Requested display " +
+                                         std::to_string(options.displayIndex) +
+                                         " does not exist");
+            }
+            return options.displayIndex;
+        }
+
+        if (display.getNumDisplayInputs() > 1) {
+            std::cout << "Display config has more than one display input, "
+                         "only the first will be used."
+                      << std::endl;
+        }
+        auto const dims = display.getDisplayDimensions(0);
+        std::cout << "HMD display input reported as " << dims.width << "x"
+                  << dims.height << std::endl;
+
+        auto ret = -1;
+        for (int i = 0; i < numDisplays; ++i) {
+            SDL_DisplayMode mode;
+            if (SDL_GetDesktopDisplayMode(i, &mode) != 0) {
+                continue;
+            }
+            std::cout << "Display " << i << ": " << mode.w << "x" << mode.h
+                      << " @ " << mode.refresh_rate << "Hz" << std::endl;
+            if (mode.w == static_cast<int>(dims.width) &&
+                mode.h == static_cast<int>(dims.height)) {
+                ret = i;
+            }
+        }
+        if (ret < 0) {
+            ret = numDisplays - 1;
+            std::cerr << "No display matches the HMD resolution, using display "
+                      << ret << " (override with --display)" << std::endl;
+        }
+        return ret;
+    }
+
+    /// @brief Opens a borderless fullscreen window at the native mode of the
+    /// HMD display, so the pattern is drawn pixel-for-pixel.
+    void createHMDWindow() {
+#ifdef SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR
+        SDL_SetHint(SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR,
+                    options.bypassCompositor ? "1" : "0");
+#endif
+        // The HMD window must stay up while the desktop (or preview) has
+        // focus.
+        SDL_SetHint(SDL_HINT_VIDEO_MINIMIZE_ON_FOCUS_LOSS, "0");
+
+        auto const displayIndex = findHMDDisplay();
+        SDL_Rect bounds;
+        SDL_DisplayMode desktop;
+        if (SDL_GetDisplayBounds(displayIndex, &bounds) != 0 ||
+            SDL_GetDesktopDisplayMode(displayIndex, &desktop) != 0) {
+            throw std::runtime_error(
+                std::string("Could not query HMD display: ") + SDL_GetError());
+        }
+        // Highest refresh rate available at the native resolution: SDL sorts
+        // the modes of a display by refresh rate, highest first.
+        SDL_DisplayMode mode = desktop;
+        auto const numModes = SDL_GetNumDisplayModes(displayIndex);
+        for (int i = 0; i < numModes; ++i) {
+            SDL_DisplayMode candidate;
+            if (SDL_GetDisplayMode(displayIndex, i, &candidate) == 0 &&
+                candidate.w == desktop.w && candidate.h == desktop.h) {
+                mode = candidate;
+                break;
+            }
+        }
+        std::cout << "Using display " << displayIndex << " at " << mode.w
+                  << "x" << mode.h << " @ " << mode.refresh_rate << "Hz"
+                  << std::endl;
+
+        window = osvr::SDL2::createWindow(
+            "OSVR", bounds.x, bounds.y, mode.w, mode.h,
+            SDL_WINDOW_OPENGL | SDL_WINDOW_BORDERLESS | SDL_WINDOW_HIDDEN);
+        if (!window) {
+            throw std::runtime_error(
+                std::string("Could not create HMD window: ") + SDL_GetError());
+        }
+        if (SDL_SetWindowDisplayMode(window.get(), &mode) != 0 ||
+            SDL_SetWindowFullscreen(window.get(), SDL_WINDOW_FULLSCREEN) != 0) {
+            std::cerr << "Could not switch to exclusive fullscreen, using a "
+                         "borderless window instead: "
+                      << SDL_GetError() << std::endl;
+        }
+        SDL_ShowWindow(window.get());
+    }
+
+    /// @brief Sets the swap interval of the HMD window per the policy and
+    /// remembers the interval actually in effect. Must be called with the
+    /// HMD window current.
+    void applySwapPolicy() {
+        switch (options.swapPolicy) {
+        case SwapPolicy::Immediate:
+            swapInterval = 0;
+            break;
+        case SwapPolicy::Adaptive:
+            swapInterval = -1;
+            if (SDL_GL_SetSwapInterval(swapInterval) == 0) {
+                return;
+            }
+            std::cerr << "Adaptive vsync not supported, using vsync."
+                      << std::endl;
+            swapInterval = 1;
+            break;
+        case SwapPolicy::VSync:
+            swapInterval = 1;
+            break;
+        }
+        SDL_GL_SetSwapInterval(swapInterval);
+    }
+
+    /// @brief Allocates the texture that the HMD back buffer is copied into
+    /// for the preview window, and sets the preview to never wait for vblank.
+    /// If the swap interval turns out to be per-drawable (GLX with
+    /// EXT_swap_control), that setting sticks and no per-frame switching is
+    /// needed in presentMirror(). Must be called after applySwapPolicy().
+    void setupMirror(osvr::SDL2::GLContext &glctx) {
+        SDL_GL_MakeCurrent(mirrorWindow.get(), glctx);
+        SDL_GL_SetSwapInterval(0);
+        SDL_GL_MakeCurrent(window.get(), glctx);
+        SDL_GL_SetSwapInterval(swapInterval);
+        SDL_GL_MakeCurrent(mirrorWindow.get(), glctx);
+        mirrorIntervalPerDrawable = SDL_GL_GetSwapInterval() == 0;
+        SDL_GL_MakeCurrent(window.get(), glctx);
+
+        SDL_GL_GetDrawableSize(window.get(), &mirrorWidth, &mirrorHeight);
+        glGenTextures(1, &mirrorTexture);
+        glBindTexture(GL_TEXTURE_2D, mirrorTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, mirrorWidth, mirrorHeight, 0,
+                     GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    /// @brief Copies the HMD back buffer into the preview texture. This is a
+    /// GPU-side copy, issued before the HMD swap.
+    void copyToMirror() {
+        glBindTexture(GL_TEXTURE_2D, mirrorTexture);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, mirrorWidth,
+                            mirrorHeight);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    /// @brief Draws and presents the preview. Called after the HMD swap and
+    /// never waits for vblank, but it still runs before the next HMD frame.
+    void presentMirror(osvr::SDL2::GLContext &glctx) {
+        auto const switchInterval =
+            !mirrorIntervalPerDrawable && swapInterval != 0;
+        SDL_GL_MakeCurrent(mirrorWindow.get(), glctx);
+        if (switchInterval) {
+            SDL_GL_SetSwapInterval(0);
+        }
+        int w, h;
+        SDL_GL_GetDrawableSize(mirrorWindow.get(), &w, &h);
+        glViewport(0, 0, w, h);
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, mirrorTexture);
+        glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+        glxxBegin(GL_QUADS, [&] {
+            glTexCoord2f(0.f, 0.f);
+            glVertex2f(-1.f, -1.f);
+            glTexCoord2f(1.f, 0.f);
+            glVertex2f(1.f, -1.f);
+            glTexCoord2f(1.f, 1.f);
+            glVertex2f(1.f, 1.f);
+            glTexCoord2f(0.f, 1.f);
+            glVertex2f(-1.f, 1.f);
+        });
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisable(GL_TEXTURE_2D);
+        SDL_GL_SwapWindow(mirrorWindow.get());
+
+        SDL_GL_MakeCurrent(window.get(), glctx);
+        if (switchInterval) {
+            SDL_GL_SetSwapInterval(swapInterval);
+        }
+    }
+
     void setQuit() { quit = true; }
     void setSurfaceDone() { surfaceDone = true; }
 
-    void handleSurface(osvr::clientkit::Surface surface, osvr::SDL2::GLContext & glctx) {
-        if (quit) {
-            return;
-        }
-        surfaceDone = false;
-        // Event handler
+    /// @brief Runs the OSVR client context update, timing it.
+    void updateOSVR() {
+        osvr::metrics::Stopwatch timer;
+        ctx.update();
+        metrics.ctxUpdate.observe(timer.lap());
+    }
+
+    /// @brief Handles queued events then renders and presents one frame,
+    /// recording per-phase timings.
+    /// @param onKey Called with the keysym of each keypress.
+    /// @param draw Draws the scene into the HMD window.
+    template <typename KeyHandler, typename Draw>
+    void runFrame(osvr::SDL2::GLContext &glctx, KeyHandler &&onKey,
+                  Draw &&draw) {
+        typedef osvr::metrics::CalibrationMetrics Metrics;
+        osvr::metrics::Stopwatch frameTimer;
+        osvr::metrics::Stopwatch phaseTimer;
+        // Handle all queued events
         SDL_Event e;
-        auto calib = EyeSurfaceCalibration{surface, display};
-        while (!surfaceDone && !quit) {
-            // Handle all queued events
-            while (SDL_PollEvent(&e)) {
-                switch (e.type) {
-                case SDL_QUIT:
-                    // Handle some system-wide quit event
+        while (SDL_PollEvent(&e)) {
+            metrics.events.increment();
+            switch (e.type) {
+            case SDL_QUIT:
+                // Handle some system-wide quit event
+                setQuit();
+                break;
+            case SDL_WINDOWEVENT:
+                // Closing either window ends the app.
+                if (e.window.event == SDL_WINDOWEVENT_CLOSE) {
                     setQuit();
-                    break;
-                case SDL_KEYDOWN:
-                    // Handle a keypress
-                    handleKeypress(calib, e.key.keysym);
-                    break;
                 }
+                break;
+            case SDL_KEYDOWN:
+                // Handle a keypress
+                onKey(e.key.keysym);
+                break;
             }
+        }
+        metrics.framePhase[Metrics::Events].observe(phaseTimer.lap());
 
-            SDL_GL_MakeCurrent(window.get(), glctx);
+        SDL_GL_MakeCurrent(window.get(), glctx);
 
-            // Clear the screen to a light blue
-            glClearColor(.3, .3, .8, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            // Update OSVR
-            ctx.update();
+        // Clear the screen to a light blue
+        glClearColor(.3, .3, .8, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        metrics.framePhase[Metrics::Clear].observe(phaseTimer.lap());
+
+        // Update OSVR
+        updateOSVR();
+        metrics.framePhase[Metrics::Update].observe(phaseTimer.lap());
+
+        // Render
+        draw();
+        metrics.framePhase[Metrics::Render].observe(phaseTimer.lap());
 
-            // Render
-            calib.render();
+        // Swap buffers. The preview's share of the work is timed on its own.
+        auto mirrorTime = osvr::metrics::Clock::duration::zero();
+        if (mirrorTexture) {
+            copyToMirror();
+            mirrorTime += phaseTimer.lap();
+        }
+        SDL_GL_SwapWindow(window.get());
+        metrics.framePhase[Metrics::Present].observe(phaseTimer.lap());
+        if (mirrorTexture) {
+            presentMirror(glctx);
+            mirrorTime += phaseTimer.lap();
+            metrics.framePhase[Metrics::Mirror].observe(mirrorTime);
+        }
+
+        metrics.frame.observe(frameTimer.lap());
+        metrics.frames.increment();
+    }
 
-            // Swap buffers
-            SDL_GL_SwapWindow(window.get());
+    void handleSurface(osvr::clientkit::Surface surface, osvr::SDL2::GLContext & glctx) {
+        if (quit) {
+            return;
+        }
+        surfaceDone = false;
+        auto calib = EyeSurfaceCalibration{surface, display};
+        osvr::metrics::Stopwatch surfaceTimer;
+        while (!surfaceDone && !quit) {
+            runFrame(glctx,
+                     [&](SDL_Keysym key) { handleKeypress(calib, key); },
+                     [&] { calib.render(); });
+        }
+        if (surfaceDone) {
+            metrics.surface.observe(surfaceTimer.lap());
+            metrics.surfacesCompleted.increment();
+            calibrated.push_back(calib);
         }
 
         std::cout << "Center: " << calib.getCenter().x << ", "
@@ -308,6 +606,50 @@ class CalibrationRoutine {
                   << std::endl;
     }
 
+    /// @brief Keeps every calibrated pattern on the HMD at full frame rate
+    /// while an external frame source re-measures the fitted circles, until
+    /// Escape is pressed.
+    void runSoak(osvr::SDL2::GLContext &glctx) {
+        std::cout << "Starting soak test, reading measurements from "
+                  << options.soakOptions.source
+                  << ", checkpointing to "
+                  << options.soakOptions.checkpointPath
+                  << ". Press Escape to stop." << std::endl;
+        std::vector<osvr::soak::SurfaceKey> surfaces;
+        for (auto const &calib : calibrated) {
+            auto const &surface = calib.getSurface();
+            surfaces.emplace_back(surface.getViewerID(), surface.getEyeID(),
+                                  surface.getSurfaceID());
+        }
+        osvr::soak::Session session(options.soakOptions,
+                                    std::move(soakSource), surfaces);
+        auto reportedEnd = false;
+        while (!quit) {
+            if (!reportedEnd && session.sourceEnded()) {
+                std::cerr << "Soak source ended after " << session.samples()
+                          << " measurements, no more will be collected. "
+                             "Press Escape to stop."
+                          << std::endl;
+                reportedEnd = true;
+            }
+            runFrame(glctx,
+                     [&](SDL_Keysym key) {
+                         if (key.scancode == SDL_SCANCODE_ESCAPE) {
+                             setQuit();
+                         }
+                     },
+                     [&] {
+                         for (auto &calib : calibrated) {
+                             calib.render();
+                         }
+                     });
+        }
+        std::cout << "Soak test stopped after " << session.samples()
+                  << " measurements"
+                  << (session.sourceEnded() ? " (source had ended)." : ".")
+                  << std::endl;
+    }
+
     void handleKeypress(EyeSurfaceCalibration &calib, SDL_Keysym key) {
         auto posChange = 1.f;
         auto sizeChange = std::int32_t{1};
@@ -349,14 +691,134 @@ class CalibrationRoutine {
     }
 
   private:
+    AppOptions options;
+    osvr::metrics::CalibrationMetrics &metrics;
+    std::unique_ptr<osvr::soak::Source> soakSource;
     osvr::clientkit::ClientContext ctx;
     osvr::clientkit::DisplayConfig display;
     osvr::SDL2::WindowPtr window;
+    osvr::SDL2::WindowPtr mirrorWindow;
+    std::vector<EyeSurfaceCalibration> calibrated;
+    GLuint mirrorTexture = 0;
+    int swapInterval = 1;
+    bool mirrorIntervalPerDrawable = false;
+    int mirrorWidth = 0;
+    int mirrorHeight = 0;
     bool quit = false;
     bool surfaceDone = false;
 };
 
+static void printUsage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  --display <n>      SDL display index of the HMD "
+                 "(default: match the OSVR display config)\n"
+              << "  --swap <policy>    immediate, vsync (default) or "
+                 "adaptive\n"
+              << "  --no-bypass-compositor\n"
+              << "                     Leave the desktop compositor enabled "
+                 "for the HMD window\n"
+              << "  --mirror           Show a scaled preview on the desktop\n"
+              << "  --metrics-port <port>\n"
+              << "                     Serve live metrics on "
+                 "http://127.0.0.1:<port>/\n"
+              << "  --soak <source>    After calibrating, keep the patterns "
+                 "up and collect\n"
+              << "                     statistics of circle fits read from "
+                 "<source> (file,\n"
+              << "                     FIFO or - for stdin), one per line: "
+                 "t viewer eye surface cx cy r\n"
+              << "  --soak-checkpoint <file>\n"
+              << "                     Soak checkpoint file (default "
+                 "soak-checkpoint.txt)\n"
+              << "  --soak-interval <seconds>\n"
+              << "                     Time between soak checkpoints "
+                 "(default 60)"
+              << std::endl;
+}
+
+/// @brief Parses a whole decimal integer, returning false if @p str is not
+/// one.
+static bool parseInt(const char *str, int &out) {
+    char *end = nullptr;
+    auto const value = std::strtol(str, &end, 10);
+    if (end == str || *end != '\0' || value < INT_MIN || value > INT_MAX) {
+        return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+/// @brief Parses the command line into @p opts, returning false on error.
+static bool parseArgs(int argc, char *argv[], AppOptions &opts) {
+    auto soakSubOption = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg = argv[i];
+        auto const hasValue = i + 1 < argc;
+        if (arg == "--display" && hasValue) {
+            if (!parseInt(argv[++i], opts.displayIndex) ||
+                opts.displayIndex < 0) {
+                return false;
+            }
+        } else if (arg == "--swap" && hasValue) {
+            std::string const policy = argv[++i];
+            if (policy == "immediate") {
+                opts.swapPolicy = SwapPolicy::Immediate;
+            } else if (policy == "vsync") {
+                opts.swapPolicy = SwapPolicy::VSync;
+            } else if (policy == "adaptive") {
+                opts.swapPolicy = SwapPolicy::Adaptive;
+            } else {
+                return false;
+            }
+        } else if (arg == "--no-bypass-compositor") {
+            opts.bypassCompositor = false;
+        } else if (arg == "--mirror") {
+            opts.mirror = true;
+        } else if (arg == "--metrics-port" && hasValue) {
+            int port;
+            if (!parseInt(argv[++i], port) || port <= 0 || port > 65535) {
+                return false;
+            }
+            opts.metricsPort = static_cast<std::uint16_t>(port);
+        } else if (arg == "--soak" && hasValue) {
+            opts.soak = true;
+            opts.soakOptions.source = argv[++i];
+        } else if (arg == "--soak-checkpoint" && hasValue) {
+            opts.soakOptions.checkpointPath = argv[++i];
+            soakSubOption = true;
+        } else if (arg == "--soak-interval" && hasValue) {
+            int seconds;
+            if (!parseInt(argv[++i], seconds) || seconds <= 0) {
+                return false;
+            }
+            opts.soakOptions.checkpointInterval =
+                std::chrono::seconds(seconds);
+            soakSubOption = true;
+        } else {
+            return false;
+        }
+    }
+    // The other soak options mean nothing without a source.
+    return opts.soak || !soakSubOption;
+}
+
 int main(int argc, char *argv[]) {
+    AppOptions opts;
+    if (!parseArgs(argc, argv, opts)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Open the soak source now, rather than after calibrating every surface.
+    std::unique_ptr<osvr::soak::Source> soakSource;
+    if (opts.soak) {
+        try {
+            soakSource.reset(new osvr::soak::Source(opts.soakOptions.source));
+        } catch (std::exception const &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
 
     osvr::SDL2::Lib lib;
 
@@ -364,7 +826,20 @@ int main(int argc, char *argv[]) {
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
 
-    CalibrationRoutine app;
+    osvr::metrics::CalibrationMetrics metrics;
+    std::unique_ptr<osvr::metrics::Exporter> exporter;
+    if (opts.metricsPort) {
+        try {
+            exporter.reset(
+                new osvr::metrics::Exporter(metrics, opts.metricsPort));
+            std::cout << "Serving metrics on http://127.0.0.1:"
+                      << opts.metricsPort << "/" << std::endl;
+        } catch (std::exception const &e) {
+            std::cerr << "Metrics disabled: " << e.what() << std::endl;
+        }
+    }
+
+    CalibrationRoutine app{opts, metrics, std::move(soakSource)};
     app();
     return 0;
 }
@@ -0,0 +1,352 @@
+/** @file
+    @brief Implementation of the optical soak-test session.
+
+    @date 2015
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2015 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "SoakSession.h"
+
+// Library/third-party includes
+#ifdef _WIN32
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Standard includes
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace osvr {
+namespace soak {
+    typedef std::chrono::steady_clock Clock;
+
+    namespace {
+        /// Longest accepted input line; anything longer is malformed.
+        static const std::size_t MAX_LINE = 1024;
+        /// How long a read may wait before the reader checks for a stop
+        /// request or a due checkpoint.
+        static const auto READ_TIMEOUT = std::chrono::milliseconds(100);
+    } // namespace
+
+    Source::Source(std::string const &path)
+        : m_path(path), m_owned(path != "-") {
+        open();
+    }
+
+    Source::~Source() { close(); }
+
+    void Source::open() {
+        if (!m_owned) {
+#ifdef _WIN32
+            m_fd = _fileno(stdin);
+#else
+            m_fd = STDIN_FILENO;
+#endif
+        } else {
+#ifdef _WIN32
+            m_fd = _open(m_path.c_str(), _O_RDONLY);
+#else
+            // Non-blocking, so opening a FIFO doesn't wait for a writer.
+            m_fd = ::open(m_path.c_str(), O_RDONLY | O_NONBLOCK);
+#endif
+            if (m_fd < 0) {
+                throw std::runtime_error("Could not open soak source " +
+                                         m_path);
+            }
+        }
+        m_readSinceOpen = false;
+
+#ifdef _WIN32
+        auto const h = reinterpret_cast<HANDLE>(_get_osfhandle(m_fd));
+        switch (GetFileType(h)) {
+        case FILE_TYPE_DISK:
+            m_kind = File;
+            break;
+        case FILE_TYPE_CHAR:
+            // A console read can't be interrupted, so stopping the soak
+            // could hang waiting for a line to be typed.
+            close();
+            throw std::runtime_error("Console input can't be used as a soak "
+                                     "source, pipe or redirect measurements "
+                                     "in instead");
+        default:
+            m_kind = Pipe;
+            break;
+        }
+#else
+        struct stat info;
+        if (fstat(m_fd, &info) == 0 && S_ISREG(info.st_mode)) {
+            m_kind = File;
+        } else if (m_owned && fstat(m_fd, &info) == 0 &&
+                   S_ISFIFO(info.st_mode)) {
+            // Only a FIFO we opened by name can be reopened.
+            m_kind = Fifo;
+        } else {
+            m_kind = Pipe;
+        }
+#endif
+    }
+
+    void Source::close() {
+        if (m_owned && m_fd >= 0) {
+#ifdef _WIN32
+            _close(m_fd);
+#else
+            ::close(m_fd);
+#endif
+        }
+        m_fd = -1;
+    }
+
+    bool Source::waitReadable(std::chrono::milliseconds timeout) {
+#ifdef _WIN32
+        auto const h = reinterpret_cast<HANDLE>(_get_osfhandle(m_fd));
+        if (m_kind == Pipe) {
+            DWORD available = 0;
+            if (!PeekNamedPipe(h, nullptr, 0, nullptr, &available, nullptr) ||
+                available > 0) {
+                // Data, or a broken pipe that the read will report as EOF.
+                return true;
+            }
+            Sleep(static_cast<DWORD>(timeout.count()));
+            return false;
+        }
+        // Disk files never block.
+        return true;
+#else
+        pollfd pfd = {};
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        // POLLHUP is reported with POLLIN clear once a FIFO writer closes.
+        return poll(&pfd, 1, static_cast<int>(timeout.count())) > 0 &&
+               (pfd.revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+#endif
+    }
+
+    Source::Result Source::readLine(std::string &line,
+                                    std::chrono::milliseconds timeout) {
+        for (;;) {
+            auto const newline = m_buffer.find('\n');
+            if (m_discarding) {
+                // Skip the rest of an overlong line.
+                if (newline == std::string::npos) {
+                    m_buffer.clear();
+                } else {
+                    m_buffer.erase(0, newline + 1);
+                    m_discarding = false;
+                    continue;
+                }
+            } else if (newline != std::string::npos) {
+                if (newline > MAX_LINE) {
+                    m_buffer.erase(0, newline + 1);
+                    continue;
+                }
+                line.assign(m_buffer, 0, newline);
+                m_buffer.erase(0, newline + 1);
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                return Line;
+            } else if (m_buffer.size() > MAX_LINE) {
+                m_buffer.clear();
+                m_discarding = true;
+            }
+
+            if (m_eof) {
+                if (m_buffer.empty() || m_discarding) {
+                    return End;
+                }
+                line.swap(m_buffer);
+                m_buffer.clear();
+                return Line;
+            }
+            if (!waitReadable(timeout)) {
+                return Timeout;
+            }
+            char chunk[512];
+#ifdef _WIN32
+            auto const n = _read(m_fd, chunk, sizeof(chunk));
+#else
+            auto const n = read(m_fd, chunk, sizeof(chunk));
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+                return Timeout;
+            }
+#endif
+            if (n > 0) {
+                m_buffer.append(chunk, static_cast<std::size_t>(n));
+                m_readSinceOpen = true;
+                continue;
+            }
+            if (n == 0 && m_kind == File) {
+                // Wait for the file to grow; keep any partial last line.
+                std::this_thread::sleep_for(timeout);
+                return Timeout;
+            }
+            if (n == 0 && m_kind == Fifo) {
+                // Writer went away: drop its partial line and reopen, which
+                // clears the hangup so we can wait for the next writer.
+                auto const hadWriter = m_readSinceOpen;
+                m_buffer.clear();
+                m_discarding = false;
+                close();
+                open();
+                if (hadWriter) {
+                    return Disconnected;
+                }
+                // Never had a writer (some platforms report the hangup
+                // anyway): don't spin.
+                std::this_thread::sleep_for(timeout);
+                return Timeout;
+            }
+            m_eof = true;
+        }
+    }
+
+    Session::Session(SoakOptions const &opts, std::unique_ptr<Source> source,
+                     std::vector<SurfaceKey> const &surfaces)
+        : m_options(opts), m_source(std::move(source)) {
+        for (auto const &key : surfaces) {
+            m_surfaces[key];
+        }
+        m_thread = std::thread([&] { run(); });
+    }
+
+    Session::~Session() {
+        m_stop = true;
+        m_thread.join();
+    }
+
+    void Session::run() {
+        auto const start = Clock::now();
+        auto nextCheckpoint = start + m_options.checkpointInterval;
+        auto elapsed = [&] {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        std::string line;
+        while (!m_stop) {
+            Source::Result result;
+            try {
+                result = m_source->readLine(line, READ_TIMEOUT);
+            } catch (std::exception const &e) {
+                // Reopening a FIFO failed.
+                std::cerr << e.what() << std::endl;
+                result = Source::End;
+            }
+            if (result == Source::End) {
+                m_sourceEnded = true;
+                break;
+            }
+            if (result == Source::Disconnected) {
+                std::cerr << "Soak source writer disconnected, waiting for it "
+                             "to reconnect."
+                          << std::endl;
+            }
+            if (result == Source::Line) {
+                std::istringstream is(line);
+                double t, cx, cy, r;
+                std::uint32_t viewer, eye, surface;
+                // Skip blank, comment or malformed lines, and surfaces that
+                // weren't calibrated.
+                if (is >> t >> viewer >> eye >> surface >> cx >> cy >> r) {
+                    auto const it =
+                        m_surfaces.find(SurfaceKey(viewer, eye, surface));
+                    if (it != m_surfaces.end()) {
+                        it->second.centerX.add(t, cx);
+                        it->second.centerY.add(t, cy);
+                        it->second.radius.add(t, r);
+                        ++m_samples;
+                    }
+                }
+            }
+            if (Clock::now() >= nextCheckpoint) {
+                writeCheckpoint(elapsed());
+                nextCheckpoint += m_options.checkpointInterval;
+            }
+        }
+        writeCheckpoint(elapsed());
+    }
+
+    void Session::writeCheckpoint(double elapsed) const {
+        auto const &path = m_options.checkpointPath;
+        auto const tmpPath = path + ".tmp";
+        {
+            std::ofstream os(tmpPath);
+            if (!os) {
+                std::cerr << "Could not write soak checkpoint " << tmpPath
+                          << std::endl;
+                return;
+            }
+            os << std::setprecision(std::numeric_limits<double>::max_digits10)
+               << "# elapsed_s " << elapsed << " samples " << m_samples
+               << " source " << (m_sourceEnded ? "ended" : "open") << "\n"
+               << "# viewer eye surface channel count mean stddev min max "
+                  "slope_per_hour p05 p50 p95\n";
+            for (auto const &entry : m_surfaces) {
+                auto writeChannel = [&](const char *name,
+                                        stats::ChannelStats const &channel) {
+                    os << std::get<0>(entry.first) << " "
+                       << std::get<1>(entry.first) << " "
+                       << std::get<2>(entry.first) << " " << name << " ";
+                    channel.write(os);
+                    os << "\n";
+                };
+                writeChannel("cx", entry.second.centerX);
+                writeChannel("cy", entry.second.centerY);
+                writeChannel("r", entry.second.radius);
+            }
+            os.close();
+            if (!os) {
+                // Keep the last good checkpoint rather than a truncated one.
+                std::cerr << "Could not write soak checkpoint " << tmpPath
+                          << std::endl;
+                std::remove(tmpPath.c_str());
+                return;
+            }
+        }
+        // Atomically replace the previous checkpoint, so a reader never sees
+        // a partial or missing file.
+#ifdef _WIN32
+        auto const replaced = MoveFileExA(tmpPath.c_str(), path.c_str(),
+                                          MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        auto const replaced = std::rename(tmpPath.c_str(), path.c_str()) == 0;
+#endif
+        if (!replaced) {
+            std::cerr << "Could not replace soak checkpoint " << path
+                      << std::endl;
+        }
+    }
+} // namespace soak
+} // namespace osvr
@@ -0,0 +1,160 @@
+/** @file
+    @brief Header declaring the optical soak-test session, which accumulates
+   streaming statistics of measured circle fits over a long run.
+
+    @date 2015
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2015 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SoakSession_h_GUID_C71B5F03_2D94_4E6A_B8F1_0A36E7D4925C
+#define INCLUDED_SoakSession_h_GUID_C71B5F03_2D94_4E6A_B8F1_0A36E7D4925C
+
+// Internal Includes
+#include "StreamingStats.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace osvr {
+namespace soak {
+    /// @brief Identifies a surface: viewer, eye, surface.
+    typedef std::tuple<std::uint32_t, std::uint32_t, std::uint32_t>
+        SurfaceKey;
+
+    /// @brief Statistics of the circle fitted to one surface.
+    struct SurfaceStats {
+        stats::ChannelStats centerX;
+        stats::ChannelStats centerY;
+        stats::ChannelStats radius;
+    };
+
+    /// @brief Configuration of a soak run.
+    struct SoakOptions {
+        /// Measurement source: a file or FIFO path, or "-" for stdin. Each
+        /// line holds one fit:
+        /// `time viewer eye surface centerX centerY radius`, with the time
+        /// in seconds as stamped by the measuring tool.
+        std::string source;
+        /// File the checkpoint is (atomically) rewritten to.
+        std::string checkpointPath = "soak-checkpoint.txt";
+        /// Time between checkpoints.
+        std::chrono::seconds checkpointInterval = std::chrono::seconds(60);
+    };
+
+    /// @brief Line-oriented measurement source whose reads can time out, so
+    /// the reader thread can always be stopped and joined.
+    ///
+    /// Reaching the end of a regular file waits for it to grow, and a named
+    /// FIFO is reopened when its writer goes away, so a restarted measuring
+    /// tool can carry on feeding a long soak. Only an anonymous pipe (or an
+    /// error) really ends the input.
+    class Source {
+      public:
+        enum Result {
+            Line,
+            Timeout,
+            /// The FIFO writer closed; waiting for a new one.
+            Disconnected,
+            End
+        };
+
+        /// @brief Opens the source without waiting for a writer.
+        /// @throws std::runtime_error if it cannot be opened, or (on
+        /// Windows) if it is an interactive console.
+        explicit Source(std::string const &path);
+        ~Source();
+
+        Source(Source const &) = delete;            //< non-copyable
+        Source &operator=(Source const &) = delete; //< non-assignable
+
+        /// @brief Reads the next line into @p line, waiting at most about
+        /// @p timeout for more input. Overlong lines are dropped whole,
+        /// keeping memory bounded.
+        Result readLine(std::string &line, std::chrono::milliseconds timeout);
+
+      private:
+        enum Kind { File, Fifo, Pipe };
+        void open();
+        void close();
+        bool waitReadable(std::chrono::milliseconds timeout);
+
+        std::string m_path;
+        Kind m_kind = Pipe;
+        int m_fd = -1;
+        bool m_owned;
+        bool m_eof = false;
+        /// Set after an overlong line, until its terminating newline.
+        bool m_discarding = false;
+        /// Whether anything was read since the FIFO was (re)opened.
+        bool m_readSinceOpen = false;
+        std::string m_buffer;
+    };
+
+    /// @brief Consumes circle-fit measurements from an external frame source
+    /// on a background thread, so the render loop never waits on it. Memory
+    /// use is constant per surface regardless of run length.
+    class Session {
+      public:
+        /// @param surfaces The calibrated surfaces; measurements of any
+        /// other surface are ignored.
+        Session(SoakOptions const &opts, std::unique_ptr<Source> source,
+                std::vector<SurfaceKey> const &surfaces);
+        /// @brief Stops and joins the reader, which writes a final
+        /// checkpoint.
+        ~Session();
+
+        Session(Session const &) = delete;            //< non-copyable
+        Session &operator=(Session const &) = delete; //< non-assignable
+
+        /// @brief Number of measurements consumed so far.
+        std::uint64_t samples() const { return m_samples; }
+
+        /// @brief Whether the source has ended, so no more measurements will
+        /// be collected.
+        bool sourceEnded() const { return m_sourceEnded; }
+
+      private:
+        void run();
+        void writeCheckpoint(double elapsed) const;
+
+        SoakOptions m_options;
+        std::unique_ptr<Source> m_source;
+        /// Only touched by the reader thread once it has started.
+        std::map<SurfaceKey, SurfaceStats> m_surfaces;
+        std::atomic<std::uint64_t> m_samples{0};
+        std::atomic<bool> m_stop{false};
+        std::atomic<bool> m_sourceEnded{false};
+        std::thread m_thread;
+    };
+} // namespace soak
+} // namespace osvr
+
+#endif // INCLUDED_SoakSession_h_GUID_C71B5F03_2D94_4E6A_B8F1_0A36E7D4925C
@@ -0,0 +1,235 @@
+/** @file
+    @brief Header containing constant-memory streaming statistics used by
+   the optical soak test.
+
+    @date 2015
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2015 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_StreamingStats_h_GUID_4E9D1A72_B35C_4A8F_A6E0_7C2D58F91B46
+#define INCLUDED_StreamingStats_h_GUID_4E9D1A72_B35C_4A8F_A6E0_7C2D58F91B46
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+namespace osvr {
+namespace stats {
+    /// @brief Running mean, variance, min/max and least-squares drift slope
+    /// of a time series, updated in O(1) time and memory per sample
+    /// (Welford's method, extended to the covariance with time).
+    class RunningStats {
+      public:
+        /// @param t Sample time, in seconds.
+        /// @param x Sample value.
+        void add(double t, double x) {
+            ++m_n;
+            auto const n = static_cast<double>(m_n);
+            auto const dt = t - m_meanT;
+            auto const dx = x - m_meanX;
+            m_meanT += dt / n;
+            m_meanX += dx / n;
+            // Uses the pre-update delta of one variable and the post-update
+            // delta of the other, which keeps these numerically stable.
+            m_m2T += dt * (t - m_meanT);
+            m_m2X += dx * (x - m_meanX);
+            m_cTX += dt * (x - m_meanX);
+            m_min = std::min(m_min, x);
+            m_max = std::max(m_max, x);
+        }
+
+        std::uint64_t count() const { return m_n; }
+        double mean() const { return m_meanX; }
+        /// @brief Sample variance (0 with fewer than two samples).
+        double variance() const {
+            return m_n > 1 ? m_m2X / static_cast<double>(m_n - 1) : 0.;
+        }
+        double stddev() const { return std::sqrt(variance()); }
+        double min() const { return m_min; }
+        double max() const { return m_max; }
+        /// @brief Least-squares slope of value versus time, in units per
+        /// second (0 until the samples span some time).
+        double slope() const { return m_m2T > 0. ? m_cTX / m_m2T : 0.; }
+
+      private:
+        std::uint64_t m_n = 0;
+        double m_meanT = 0.;
+        double m_meanX = 0.;
+        double m_m2T = 0.;
+        double m_m2X = 0.;
+        double m_cTX = 0.;
+        double m_min = std::numeric_limits<double>::infinity();
+        double m_max = -std::numeric_limits<double>::infinity();
+    };
+
+    /// @brief Estimates a single quantile of a stream using the P-squared
+    /// algorithm (Jain and Chlamtac, 1985): five markers, no stored samples.
+    class QuantileSketch {
+      public:
+        /// @param p Quantile to estimate, in (0, 1).
+        explicit QuantileSketch(double p = 0.5)
+            : m_p(p), m_desired{{0., 2. * p, 4. * p, 2. + 2. * p, 4.}},
+              m_increment{{0., p / 2., p, (1. + p) / 2., 1.}} {}
+
+        void add(double x) {
+            if (m_n < NumMarkers) {
+                m_height[m_n] = x;
+                ++m_n;
+                if (m_n == NumMarkers) {
+                    std::sort(m_height.begin(), m_height.end());
+                    for (std::size_t i = 0; i < NumMarkers; ++i) {
+                        m_pos[i] = static_cast<double>(i);
+                    }
+                }
+                return;
+            }
+            ++m_n;
+
+            // Find the cell containing x, extending the extremes if needed.
+            std::size_t k;
+            if (x < m_height[0]) {
+                m_height[0] = x;
+                k = 0;
+            } else if (x >= m_height[4]) {
+                m_height[4] = std::max(m_height[4], x);
+                k = 3;
+            } else {
+                k = 0;
+                while (x >= m_height[k + 1]) {
+                    ++k;
+                }
+            }
+            for (std::size_t i = k + 1; i < NumMarkers; ++i) {
+                m_pos[i] += 1.;
+            }
+            for (std::size_t i = 0; i < NumMarkers; ++i) {
+                m_desired[i] += m_increment[i];
+            }
+
+            // Nudge the middle markers towards their desired positions.
+            for (std::size_t i = 1; i < NumMarkers - 1; ++i) {
+                auto const d = m_desired[i] - m_pos[i];
+                if ((d >= 1. && m_pos[i + 1] - m_pos[i] > 1.) ||
+                    (d <= -1. && m_pos[i - 1] - m_pos[i] < -1.)) {
+                    auto const s = d > 0. ? 1. : -1.;
+                    auto const h = parabolic(i, s);
+                    if (m_height[i - 1] < h && h < m_height[i + 1]) {
+                        m_height[i] = h;
+                    } else {
+                        m_height[i] = linear(i, s);
+                    }
+                    m_pos[i] += s;
+                }
+            }
+        }
+
+        double quantile() const { return m_p; }
+
+        /// @brief Current estimate (NaN before any samples).
+        double estimate() const {
+            if (m_n == 0) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            if (m_n < NumMarkers) {
+                auto sorted = m_height;
+                std::sort(sorted.begin(), sorted.begin() + m_n);
+                auto const idx = static_cast<std::size_t>(
+                    std::floor(m_p * static_cast<double>(m_n - 1) + 0.5));
+                return sorted[idx];
+            }
+            return m_height[2];
+        }
+
+      private:
+        static const std::size_t NumMarkers = 5;
+
+        double parabolic(std::size_t i, double s) const {
+            auto const &n = m_pos;
+            auto const &q = m_height;
+            return q[i] +
+                   s / (n[i + 1] - n[i - 1]) *
+                       ((n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) /
+                            (n[i + 1] - n[i]) +
+                        (n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) /
+                            (n[i] - n[i - 1]));
+        }
+        double linear(std::size_t i, double s) const {
+            auto const j = s > 0. ? i + 1 : i - 1;
+            return m_height[i] +
+                   s * (m_height[j] - m_height[i]) / (m_pos[j] - m_pos[i]);
+        }
+
+        double m_p;
+        std::size_t m_n = 0;
+        std::array<double, NumMarkers> m_height{};
+        std::array<double, NumMarkers> m_pos{};
+        std::array<double, NumMarkers> m_desired;
+        std::array<double, NumMarkers> m_increment;
+    };
+
+    /// @brief All the statistics tracked for one measured quantity.
+    class ChannelStats {
+      public:
+        ChannelStats() : m_quantiles{{QuantileSketch(0.05), QuantileSketch(0.5),
+                                      QuantileSketch(0.95)}} {}
+
+        void add(double t, double x) {
+            m_stats.add(t, x);
+            for (auto &q : m_quantiles) {
+                q.add(x);
+            }
+        }
+
+        RunningStats const &stats() const { return m_stats; }
+
+        /// @brief Writes a compact, single-line, whitespace-separated summary:
+        /// count mean stddev min max slope_per_hour p05 p50 p95
+        /// Values are written at full double precision, so sub-pixel drift
+        /// survives a round trip.
+        void write(std::ostream &os) const {
+            auto const precision = os.precision(
+                std::numeric_limits<double>::max_digits10);
+            os << m_stats.count() << " " << m_stats.mean() << " "
+               << m_stats.stddev() << " " << m_stats.min() << " "
+               << m_stats.max() << " " << m_stats.slope() * 3600.;
+            for (auto const &q : m_quantiles) {
+                os << " " << q.estimate();
+            }
+            os.precision(precision);
+        }
+
+      private:
+        RunningStats m_stats;
+        std::array<QuantileSketch, 3> m_quantiles;
+    };
+} // namespace stats
+} // namespace osvr
+
+#endif // INCLUDED_StreamingStats_h_GUID_4E9D1A72_B35C_4A8F_A6E0_7C2D58F91B46